@@ -31,20 +31,91 @@
 /* Network Specific Headers */
 # include <signal.h>
 # include <sys/time.h>
+# include <time.h>
 # include <arpa/inet.h>
 # include <sys/socket.h>
 # include <netdb.h>
 # include <netinet/ip.h>
 # include <netinet/ip_icmp.h>
 # include <errno.h>
+# include <poll.h>
+# include <stdint.h>
+# include <sys/un.h>
+# include <linux/filter.h>
 
 /* Configuration */
 # define PING_PKT_SIZE 64
 # define RECV_BUFFER_SIZE 1024
+/* Room for the largest IP header (60 bytes) in the receive buffer */
+# define PING_PKT_MAX (RECV_BUFFER_SIZE - 60)
+/* ICMP header (8 bytes) + the timestamp we hide in the payload */
+# define PING_PKT_MIN (8 + (int)sizeof(struct timeval))
 # define TTL_DEFAULT 64
 
+/* Low-latency mode */
+# define LL_RECV_TIMEOUT_US 1000000L
+# define LL_FIFO_PRIORITY 50
+# define LL_PREFAULT_STACK (64 * 1024)
+
+/* Daemon mode */
+# define DAEMON_MAX_TARGETS 64
+# define DAEMON_MAX_CLIENTS 8
+# define DAEMON_HOST_LEN 256
+# define DAEMON_CMD_LEN 512
+
+/* ** Hot-Path Profiler
+** Compiled in with `make PROFILE=1` (-DFT_PING_PROFILE) and switched on
+** with --profile. Compiled out, the PROF_* macros expand to nothing.
+*/
+typedef enum e_prof_id
+{
+    PROF_CRAFT,
+    PROF_CHECKSUM,
+    PROF_SEND,
+    PROF_RECV,
+    PROF_PARSE,
+    PROF_STATS,
+    PROF_OUTPUT,
+    PROF_LOOP,
+    PROF_COUNT
+}   t_prof_id;
+
+# ifdef FT_PING_PROFILE
+#  define PROF_BUCKETS 64
+
+typedef struct s_prof_stage
+{
+    uint64_t    count;
+    uint64_t    sum_ns;
+    uint64_t    hist[PROF_BUCKETS];
+}   t_prof_stage;
+
+extern int g_profile;
+
+static inline uint64_t prof_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+void            prof_record(t_prof_id stage, uint64_t start);
+void            prof_report(void);
+
+#  define PROF_ENABLED g_profile
+#  define PROF_START(t) uint64_t t = (g_profile ? prof_now() : 0)
+#  define PROF_END(stage, t) do { if (g_profile) prof_record(stage, t); } while (0)
+# else
+#  define PROF_ENABLED 0
+#  define PROF_START(t) do { } while (0)
+#  define PROF_END(stage, t) do { } while (0)
+# endif
+
 /* ** The Global Logbook
 ** We use double for calculations to handle sub-millisecond precision.
+** rx_dropped is the kernel's SO_RXQ_OVFL counter (cumulative, per socket);
+** tx_nobufs counts sends refused with ENOBUFS/EAGAIN (never transmitted).
 */
 typedef struct s_ping_stats
 {
@@ -54,6 +125,8 @@ typedef struct s_ping_stats
     double  t_max;
     double  t_sum;
     double  t_sq_sum;
+    long    rx_dropped;
+    long    tx_nobufs;
 }   t_ping_stats;
 
 typedef struct s_ping
@@ -70,17 +143,74 @@ typedef struct s_ping
     int                 flood;
     int                 ttl;
     int                 deadline;
+    int                 low_latency;
+    int                 cpu;
+    int                 busy_poll;
+    int                 pkt_size;
+    int                 rcvbuf;
+    int                 sndbuf;
+    char                *ctl_path;
 }   t_ping;
 
+/* ** Daemon Fleet
+** Each target is a full t_ping sharing the daemon's raw socket.
+** The ICMP id of a target is the daemon's base id + its slot.
+** next_send is on CLOCK_MONOTONIC so a wall clock step cannot stall it.
+*/
+typedef struct s_target
+{
+    t_ping          ping;
+    char            host[DAEMON_HOST_LEN];
+    int             active;
+    int             seq;
+    struct timespec next_send;
+}   t_target;
+
+typedef struct s_client
+{
+    int     fd;
+    size_t  len;
+    char    buf[DAEMON_CMD_LEN];
+}   t_client;
+
+typedef struct s_daemon
+{
+    int         sockfd;
+    int         listen_fd;
+    int         cur_ttl;
+    int         base_id;
+    int         stop;
+    long        rx_dropped;
+    char        *ctl_path;
+    t_ping      defaults;
+    t_target    targets[DAEMON_MAX_TARGETS];
+    t_client    clients[DAEMON_MAX_CLIENTS];
+}   t_daemon;
+
 /* Global Access for Signal Handlers */
 extern t_ping *g_ping;
 
 /* Prototypes */
 unsigned short  checksum(void *b, int len);
 void            init_socket(t_ping *ping);
+void            open_socket(t_ping *ping);
+void            set_icmp_filter(int sockfd, int id, int count, int errors);
+int             resolve_hostname(t_ping *ping);
+ssize_t         recv_packet(int sockfd, char *buf, size_t len, int flags,
+                            long *drops);
 void            craft_packet(t_ping *ping, char *buf, int seq);
 void            loop_ping(t_ping *ping);
 void            print_stats(t_ping *ping);
+void            calculate_stats(t_ping *ping, double *avg, double *stddev);
+double          get_time_diff(struct timeval *start, struct timeval *end);
+void            update_stats(t_ping *ping, double rtt);
 void            handle_signal(int sig);
+void            setup_low_latency(t_ping *ping);
+ssize_t         spin_recv(t_ping *ping, char *buf, size_t len);
+void            run_daemon(t_ping *ping);
+double          get_mono_diff(struct timespec *start, struct timespec *end);
+int             add_target(t_daemon *d, char *host, t_ping *tmpl,
+                           const char **err);
+void            daemon_command(t_daemon *d, int fd, char *line);
 
 #endif
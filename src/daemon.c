@@ -0,0 +1,411 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                        ______                                              */
+/*                     .-"      "-.                                           */
+/*                    /            \                                          */
+/*        _          |              |          _                              */
+/*       ( \         |,  .-.  .-.  ,|         / )                             */
+/*        > "=._     | )(__/  \__)( |     _.=" <                              */
+/*       (_/"=._"=._ |/     /\     \| _.="_.="\_)                             */
+/*              "=._ (_     ^^     _)"_.="                                    */
+/*                  "=\__|IIIIII|__/="                                        */
+/*                 _.="| \IIIIII/ |"=._                                       */
+/*       _     _.="_.="\          /"=._"=._     _                             */
+/*      ( \_.="_.="     `--------`     "=._"=._/ )                            */
+/*       > _.="                            "=._ <                             */
+/*      (_/                                    \_)                            */
+/*                                                                            */
+/*      Filename: daemon.c                                                    */
+/*      By: espadara <espadara@pirate.capn.gg>                                */
+/*      Created: 2025/12/07 14:02:11 by espadara                              */
+/*      Updated: 2025/12/07 14:02:11 by espadara                              */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "ft_ping.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+static volatile sig_atomic_t g_daemon_stop = 0;
+
+static void daemon_signal(int sig)
+{
+  (void)sig;
+  g_daemon_stop = 1;
+}
+
+static void set_nonblock(int fd)
+{
+  int flags;
+
+  flags = fcntl(fd, F_GETFL, 0);
+  if (flags >= 0)
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/**
+ * remove_stale - Clears a socket left behind by a previous daemon.
+ *
+ * We run as root: anything at @path that is not a socket is refused,
+ * never deleted.
+ */
+static void remove_stale(char *path)
+{
+  struct stat st;
+
+  if (lstat(path, &st) < 0)
+    {
+      if (errno == ENOENT)
+        return;
+      sea_printf("ft_ping: %s: %s\n", path, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+  if (!S_ISSOCK(st.st_mode))
+    {
+      sea_printf("ft_ping: %s: exists and is not a socket\n", path);
+      exit(EXIT_FAILURE);
+    }
+  unlink(path);
+}
+
+/**
+ * open_control - Creates the Unix control socket.
+ * @path: Filesystem path of the socket (a stale socket is replaced).
+ *
+ * The socket is created 0600 (umask 077 around bind): whoever talks
+ * to it drives a root process.
+ */
+static int open_control(char *path)
+{
+  struct sockaddr_un addr;
+  mode_t             old_mask;
+  int                fd;
+  int                ret;
+
+  sea_memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path))
+    {
+      sea_printf("ft_ping: control socket path too long: %s\n", path);
+      exit(EXIT_FAILURE);
+    }
+  sea_memcpy_fast(addr.sun_path, path, strlen(path));
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    {
+      sea_printf("ft_ping: Control socket error: %s\n", strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+  remove_stale(path);
+  old_mask = umask(077);
+  ret = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+  umask(old_mask);
+  if (ret < 0 || listen(fd, DAEMON_MAX_CLIENTS) < 0)
+    {
+      sea_printf("ft_ping: %s: %s\n", path, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+  set_nonblock(fd);
+  return (fd);
+}
+
+/* Same as get_time_diff, for the CLOCK_MONOTONIC schedule */
+double get_mono_diff(struct timespec *start, struct timespec *end)
+{
+  double s;
+  double e;
+
+  s = start->tv_sec * 1000.0 + start->tv_nsec / 1000000.0;
+  e = end->tv_sec * 1000.0 + end->tv_nsec / 1000000.0;
+  return (e - s);
+}
+
+/**
+ * next_timeout - Milliseconds until the earliest target is due.
+ *
+ * Returns -1 (block until a command arrives) when the fleet is empty,
+ * clamped to INT_MAX for very long intervals.
+ */
+static int next_timeout(t_daemon *d)
+{
+  struct timespec now;
+  double          wait;
+  double          best;
+  int             i;
+
+  best = -1.0;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  for (i = 0; i < DAEMON_MAX_TARGETS; i++)
+    {
+      if (!d->targets[i].active)
+        continue;
+      wait = get_mono_diff(&now, &d->targets[i].next_send);
+      if (wait < 0.0)
+        wait = 0.0;
+      if (best < 0.0 || wait < best)
+        best = wait;
+    }
+  if (best < 0.0)
+    return (-1);
+  // interval=N is unbounded: a negative timeout would block poll() forever
+  if (best >= (double)INT_MAX - 1.0)
+    return (INT_MAX);
+  return ((int)best + 1);
+}
+
+static void schedule_next(t_target *t, struct timespec *now)
+{
+  t->next_send.tv_sec += t->ping.interval;
+  // Fell behind (a slow control client, a stopped process): restart the
+  // beat from now instead of bursting the missed probes
+  if (get_mono_diff(now, &t->next_send) <= 0.0)
+    {
+      t->next_send = *now;
+      t->next_send.tv_sec += t->ping.interval;
+    }
+}
+
+/**
+ * send_probes - Fires one Echo Request for every target that is due.
+ *
+ * All targets share one raw socket, so IP_TTL is switched on the fly
+ * only when the next target wants a different value.
+ */
+static void send_probes(t_daemon *d)
+{
+  char            send_buf[PING_PKT_MAX];
+  struct timespec now;
+  t_target        *t;
+  int             i;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  for (i = 0; i < DAEMON_MAX_TARGETS; i++)
+    {
+      t = &d->targets[i];
+      if (!t->active || get_mono_diff(&now, &t->next_send) > 0.0)
+        continue;
+      if (t->ping.ttl != d->cur_ttl
+          && setsockopt(d->sockfd, IPPROTO_IP, IP_TTL,
+                        &t->ping.ttl, sizeof(t->ping.ttl)) == 0)
+        d->cur_ttl = t->ping.ttl;
+      craft_packet(&t->ping, send_buf, ++t->seq);
+      if (sendto(d->sockfd, send_buf, t->ping.pkt_size, 0,
+                 (struct sockaddr *)&t->ping.dest_addr, sizeof(t->ping.dest_addr)) < 0)
+        {
+          if (errno == ENOBUFS || errno == EAGAIN)
+            t->ping.stats.tx_nobufs++;
+          else if (t->ping.verbose)
+            sea_printf("ft_ping: %s: sendto error\n", t->host);
+        }
+      else
+        t->ping.stats.tx_packets++;
+      schedule_next(t, &now);
+    }
+}
+
+/**
+ * handle_reply - Credits an Echo Reply to the target that sent it.
+ *
+ * The ICMP id tells us the slot; the source address guards against
+ * a late reply landing on a slot that was deleted and re-used.
+ */
+static void handle_reply(t_daemon *d, char *buf, ssize_t ret)
+{
+  struct ip       *ip_header;
+  struct icmp     *icmp_header;
+  struct timeval  sent_time;
+  struct timeval  curr_time;
+  t_target        *t;
+  unsigned short  slot;
+  int             hlen;
+
+  ip_header = (struct ip *)buf;
+  hlen = ip_header->ip_hl << 2;
+  if (ret < hlen + PING_PKT_MIN)
+    return;
+  icmp_header = (struct icmp *)(buf + hlen);
+  if (icmp_header->icmp_type != ICMP_ECHOREPLY)
+    return;
+  slot = (unsigned short)(ntohs(icmp_header->icmp_id) - d->base_id);
+  if (slot >= DAEMON_MAX_TARGETS)
+    return;
+  t = &d->targets[slot];
+  if (!t->active || ip_header->ip_src.s_addr != t->ping.dest_addr.sin_addr.s_addr)
+    return;
+  sea_memcpy_fast(&sent_time, buf + hlen + 8, sizeof(sent_time));
+  gettimeofday(&curr_time, NULL);
+  update_stats(&t->ping, get_time_diff(&sent_time, &curr_time));
+}
+
+static void drain_replies(t_daemon *d)
+{
+  char    recv_buf[RECV_BUFFER_SIZE];
+  ssize_t ret;
+
+  while (1)
+    {
+      ret = recv_packet(d->sockfd, recv_buf, RECV_BUFFER_SIZE, MSG_DONTWAIT,
+                        &d->rx_dropped);
+      if (ret <= 0)
+        return;
+      handle_reply(d, recv_buf, ret);
+    }
+}
+
+static void close_client(t_client *c)
+{
+  close(c->fd);
+  c->fd = -1;
+  c->len = 0;
+}
+
+static void accept_client(t_daemon *d)
+{
+  int fd;
+  int i;
+
+  fd = accept(d->listen_fd, NULL, NULL);
+  if (fd < 0)
+    return;
+  for (i = 0; i < DAEMON_MAX_CLIENTS; i++)
+    {
+      if (d->clients[i].fd < 0)
+        {
+          set_nonblock(fd);
+          d->clients[i].fd = fd;
+          d->clients[i].len = 0;
+          return;
+        }
+    }
+  dprintf(fd, "error too many clients\n");
+  close(fd);
+}
+
+/**
+ * read_client - Buffers input and runs every complete command line.
+ */
+static void read_client(t_daemon *d, t_client *c)
+{
+  ssize_t n;
+  char    *nl;
+  size_t  used;
+
+  n = read(c->fd, c->buf + c->len, sizeof(c->buf) - c->len - 1);
+  if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+    {
+      close_client(c);
+      return;
+    }
+  if (n < 0)
+    return;
+  c->len += n;
+  c->buf[c->len] = '\0';
+  while ((nl = strchr(c->buf, '\n')) != NULL)
+    {
+      *nl = '\0';
+      daemon_command(d, c->fd, c->buf);
+      used = nl - c->buf + 1;
+      memmove(c->buf, nl + 1, c->len - used + 1);
+      c->len -= used;
+    }
+  if (c->len == sizeof(c->buf) - 1)
+    {
+      dprintf(c->fd, "error command too long\n");
+      close_client(c);
+    }
+}
+
+/**
+ * daemon_loop - The heartbeat of the fleet.
+ *
+ * poll() sleeps until the next probe is due, a reply lands or a
+ * command arrives, so reconfiguring one target never stalls the others.
+ */
+static void daemon_loop(t_daemon *d)
+{
+  struct pollfd fds[2 + DAEMON_MAX_CLIENTS];
+  t_client      *owner[2 + DAEMON_MAX_CLIENTS];
+  int           nfds;
+  int           i;
+
+  while (!g_daemon_stop && !d->stop)
+    {
+      fds[0].fd = d->sockfd;
+      fds[0].events = POLLIN;
+      fds[1].fd = d->listen_fd;
+      fds[1].events = POLLIN;
+      nfds = 2;
+      for (i = 0; i < DAEMON_MAX_CLIENTS; i++)
+        {
+          if (d->clients[i].fd < 0)
+            continue;
+          fds[nfds].fd = d->clients[i].fd;
+          fds[nfds].events = POLLIN;
+          owner[nfds++] = &d->clients[i];
+        }
+      if (poll(fds, nfds, next_timeout(d)) < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          sea_printf("ft_ping: poll error: %s\n", strerror(errno));
+          break;
+        }
+      if (fds[0].revents & POLLIN)
+        drain_replies(d);
+      if (fds[1].revents & POLLIN)
+        accept_client(d);
+      for (i = 2; i < nfds; i++)
+        if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+          read_client(d, owner[i]);
+      send_probes(d);
+    }
+}
+
+/**
+ * run_daemon - Keeps the raw socket open and probes until told to stop.
+ * @ping: Parsed options; they become the defaults for new targets.
+ *
+ * HOST given on the command line (if any) is added as target 0.
+ * On SIGINT/SIGTERM or 'shutdown', prints the logbook of every target.
+ */
+void run_daemon(t_ping *ping)
+{
+  t_daemon    d;
+  const char  *err;
+  int         i;
+
+  sea_bzero(&d, sizeof(d));
+  g_ping = NULL;
+  open_socket(ping);
+  d.sockfd = ping->sockfd;
+  d.cur_ttl = ping->ttl;
+  d.base_id = ping->pid & 0xFFFF;
+  set_icmp_filter(d.sockfd, d.base_id, DAEMON_MAX_TARGETS, 0);
+  d.ctl_path = ping->ctl_path;
+  d.defaults = *ping;
+  for (i = 0; i < DAEMON_MAX_CLIENTS; i++)
+    d.clients[i].fd = -1;
+  if (ping->hostname != NULL && add_target(&d, ping->hostname, &d.defaults, &err) < 0)
+    {
+      sea_printf("ft_ping: %s: %s\n", ping->hostname, err);
+      exit(EXIT_FAILURE);
+    }
+  d.listen_fd = open_control(d.ctl_path);
+  signal(SIGINT, daemon_signal);
+  signal(SIGTERM, daemon_signal);
+  signal(SIGPIPE, SIG_IGN);
+  sea_printf("ft_ping: daemon listening on %s\n", d.ctl_path);
+
+  daemon_loop(&d);
+
+  for (i = 0; i < DAEMON_MAX_CLIENTS; i++)
+    if (d.clients[i].fd >= 0)
+      close_client(&d.clients[i]);
+  close(d.listen_fd);
+  unlink(d.ctl_path);
+  for (i = 0; i < DAEMON_MAX_TARGETS; i++)
+    if (d.targets[i].active)
+      print_stats(&d.targets[i].ping);
+  close(d.sockfd);
+}
@@ -0,0 +1,291 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                        ______                                              */
+/*                     .-"      "-.                                           */
+/*                    /            \                                          */
+/*        _          |              |          _                              */
+/*       ( \         |,  .-.  .-.  ,|         / )                             */
+/*        > "=._     | )(__/  \__)( |     _.=" <                              */
+/*       (_/"=._"=._ |/     /\     \| _.="_.="\_)                             */
+/*              "=._ (_     ^^     _)"_.="                                    */
+/*                  "=\__|IIIIII|__/="                                        */
+/*                 _.="| \IIIIII/ |"=._                                       */
+/*       _     _.="_.="\          /"=._"=._     _                             */
+/*      ( \_.="_.="     `--------`     "=._"=._/ )                            */
+/*       > _.="                            "=._ <                             */
+/*      (_/                                    \_)                            */
+/*                                                                            */
+/*      Filename: daemon_cmd.c                                                */
+/*      By: espadara <espadara@pirate.capn.gg>                                */
+/*      Created: 2025/12/07 15:20:48 by espadara                              */
+/*      Updated: 2025/12/07 15:20:48 by espadara                              */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "ft_ping.h"
+#include <limits.h>
+
+/*
+** Control protocol: one command per line, one reply per command.
+**
+**   add ADDR [interval=N] [ttl=N] [size=N]   -> ok ID
+**   del ID                                   -> ok
+**   set ID [interval=N] [ttl=N] [size=N]     -> ok
+**   stats [ID]                               -> one line per target, then
+**                                               end rxq_drops=N (socket-wide)
+**   shutdown                                 -> ok
+**
+** Failures answer "error <reason>". size is the ICMP data size, like -s.
+** ADDR must be an IPv4 literal: a blocking getaddrinfo() here would stall
+** every other target for the whole resolver timeout.
+*/
+
+/**
+ * parse_num - Strict decimal parser for anything a client sends us.
+ * @s: The token (digits only: no sign, no spaces, no trailing junk).
+ * @min: Smallest accepted value.
+ * @max: Largest accepted value.
+ * @out: Where the value goes on success.
+ *
+ * Returns 0, or -1 if @s is not entirely a number within [min, max].
+ */
+static int parse_num(char *s, long min, long max, int *out)
+{
+  char *end;
+  long n;
+
+  if (s == NULL || *s < '0' || *s > '9')
+    return (-1);
+  errno = 0;
+  n = strtol(s, &end, 10);
+  if (errno != 0 || *end != '\0' || n < min || n > max)
+    return (-1);
+  *out = (int)n;
+  return (0);
+}
+
+/**
+ * add_target - Resolves HOST once and puts it in a free slot.
+ * @d: The daemon.
+ * @host: Name or address to probe.
+ * @tmpl: Settings (interval, ttl, pkt_size) to start with.
+ * @err: Set to a reason on failure.
+ *
+ * Returns the slot (= target ID) or -1. The first probe is sent at once.
+ */
+int add_target(t_daemon *d, char *host, t_ping *tmpl, const char **err)
+{
+  t_target *t;
+  int      slot;
+  int      status;
+
+  if (strlen(host) >= DAEMON_HOST_LEN)
+    {
+      *err = "host name too long";
+      return (-1);
+    }
+  for (slot = 0; slot < DAEMON_MAX_TARGETS && d->targets[slot].active; slot++)
+    ;
+  if (slot == DAEMON_MAX_TARGETS)
+    {
+      *err = "target table full";
+      return (-1);
+    }
+  t = &d->targets[slot];
+  sea_bzero(t, sizeof(*t));
+  sea_memcpy_fast(t->host, host, strlen(host) + 1);
+  t->ping = *tmpl;
+  t->ping.hostname = t->host;
+  t->ping.sockfd = d->sockfd;
+  t->ping.pid = d->base_id + slot;
+  sea_bzero(&t->ping.stats, sizeof(t->ping.stats));
+  status = resolve_hostname(&t->ping);
+  if (status != 0)
+    {
+      *err = gai_strerror(status);
+      return (-1);
+    }
+  gettimeofday(&t->ping.start_time, NULL);
+  clock_gettime(CLOCK_MONOTONIC, &t->next_send);
+  t->active = 1;
+  return (slot);
+}
+
+/**
+ * apply_option - Parses one key=value setting into @p.
+ *
+ * Returns 0, or -1 with @err set. Callers apply options to a copy so a
+ * bad line never leaves a target half-reconfigured.
+ */
+static int apply_option(t_ping *p, char *opt, const char **err)
+{
+  char *val;
+  int  n;
+
+  val = strchr(opt, '=');
+  if (val == NULL)
+    {
+      *err = "expected key=value";
+      return (-1);
+    }
+  *val++ = '\0';
+  if (sea_strcmp(opt, "interval") == 0 && parse_num(val, 1, INT_MAX, &n) == 0)
+    p->interval = n;
+  else if (sea_strcmp(opt, "ttl") == 0 && parse_num(val, 1, 255, &n) == 0)
+    p->ttl = n;
+  else if (sea_strcmp(opt, "size") == 0
+           && parse_num(val, PING_PKT_MIN - 8, PING_PKT_MAX - 8, &n) == 0)
+    p->pkt_size = n + 8;
+  else
+    {
+      *err = "bad option or value";
+      return (-1);
+    }
+  return (0);
+}
+
+static int apply_options(t_ping *p, char **save, const char **err)
+{
+  char *opt;
+
+  while ((opt = strtok_r(NULL, " \t\r", save)) != NULL)
+    if (apply_option(p, opt, err) < 0)
+      return (-1);
+  return (0);
+}
+
+/**
+ * reschedule - Pulls the next probe in when the interval shrinks.
+ *
+ * The last probe went out one old interval before next_send; the next
+ * one is due one new interval after it. A date in the past just means
+ * send_probes fires right away.
+ */
+static void reschedule(t_target *t, int old_interval)
+{
+  struct timespec due;
+
+  due = t->next_send;
+  due.tv_sec += t->ping.interval - old_interval;
+  if (get_mono_diff(&due, &t->next_send) > 0.0)
+    t->next_send = due;
+}
+
+static t_target *find_target(t_daemon *d, char *tok)
+{
+  int slot;
+
+  if (parse_num(tok, 0, DAEMON_MAX_TARGETS - 1, &slot) < 0
+      || !d->targets[slot].active)
+    return (NULL);
+  return (&d->targets[slot]);
+}
+
+static void print_target(int fd, t_target *t, int slot)
+{
+  t_ping *p;
+  double avg;
+  double stddev;
+  long   loss_pct;
+
+  p = &t->ping;
+  calculate_stats(p, &avg, &stddev);
+  loss_pct = 0;
+  if (p->stats.tx_packets > 0)
+    loss_pct = ((p->stats.tx_packets - p->stats.rx_packets) * 100)
+      / p->stats.tx_packets;
+  dprintf(fd, "%d %s %s interval=%d ttl=%d size=%d tx=%ld rx=%ld loss=%ld%%"
+          " nobufs=%ld rtt=%.3f/%.3f/%.3f/%.3f\n",
+          slot, t->host, p->ip_str, p->interval, p->ttl, p->pkt_size - 8,
+          p->stats.tx_packets, p->stats.rx_packets, loss_pct, p->stats.tx_nobufs,
+          p->stats.t_min, avg, p->stats.t_max, stddev);
+}
+
+static void cmd_stats(t_daemon *d, int fd, char *tok)
+{
+  t_target *t;
+  int      i;
+
+  if (tok != NULL)
+    {
+      if ((t = find_target(d, tok)) == NULL)
+        {
+          dprintf(fd, "error no such target\n");
+          return;
+        }
+      print_target(fd, t, t - d->targets);
+    }
+  else
+    for (i = 0; i < DAEMON_MAX_TARGETS; i++)
+      if (d->targets[i].active)
+        print_target(fd, &d->targets[i], i);
+  dprintf(fd, "end rxq_drops=%ld\n", d->rx_dropped);
+}
+
+/**
+ * daemon_command - Executes one control line and answers on @fd.
+ */
+void daemon_command(t_daemon *d, int fd, char *line)
+{
+  char       *save;
+  char       *cmd;
+  char       *arg;
+  t_target   *t;
+  t_ping     tmp;
+  const char *err;
+  int        slot;
+  struct in_addr addr;
+
+  cmd = strtok_r(line, " \t\r", &save);
+  if (cmd == NULL)
+    return;
+  arg = strtok_r(NULL, " \t\r", &save);
+  err = "unknown command";
+  if (sea_strcmp(cmd, "add") == 0 && arg != NULL)
+    {
+      tmp = d->defaults;
+      err = "add takes an IPv4 address, not a name";
+      if (inet_pton(AF_INET, arg, &addr) == 1
+          && apply_options(&tmp, &save, &err) == 0
+          && (slot = add_target(d, arg, &tmp, &err)) >= 0)
+        {
+          dprintf(fd, "ok %d\n", slot);
+          return;
+        }
+    }
+  else if (sea_strcmp(cmd, "set") == 0 || sea_strcmp(cmd, "del") == 0)
+    {
+      err = "no such target";
+      if ((t = find_target(d, arg)) != NULL)
+        {
+          tmp = t->ping;
+          if (cmd[0] == 'd')
+            t->active = 0;
+          else if (apply_options(&tmp, &save, &err) < 0)
+            t = NULL;
+          else
+            {
+              slot = t->ping.interval;
+              t->ping = tmp;
+              reschedule(t, slot);
+            }
+        }
+      if (t != NULL)
+        {
+          dprintf(fd, "ok\n");
+          return;
+        }
+    }
+  else if (sea_strcmp(cmd, "stats") == 0)
+    {
+      cmd_stats(d, fd, arg);
+      return;
+    }
+  else if (sea_strcmp(cmd, "shutdown") == 0)
+    {
+      d->stop = 1;
+      dprintf(fd, "ok\n");
+      return;
+    }
+  dprintf(fd, "error %s\n", err);
+}
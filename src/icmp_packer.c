@@ -27,8 +27,8 @@
 
 /**
  * craft_packet - Assembles the ICMP Echo Request.
- * @ping: The global struct (for PID/ID).
- * @buf: The stack-allocated buffer to write into.
+ * @ping: The global struct (for PID/ID and packet size).
+ * @buf: The stack-allocated buffer to write into (zeroed here).
  * @seq: The current sequence number.
  *
  * Structure:
@@ -39,6 +39,8 @@ void craft_packet(t_ping *ping, char *buf, int seq)
   struct icmp *icmp;
   struct timeval tv;
 
+  PROF_START(t_craft);
+  sea_bzero(buf, ping->pkt_size);
   // Point struct to buffer (No Malloc!)
   icmp = (struct icmp *)buf;
 
@@ -50,8 +52,11 @@ void craft_packet(t_ping *ping, char *buf, int seq)
   // Embed Timestamp in Payload
   gettimeofday(&tv, NULL);
   sea_memcpy_fast(buf + 8, &tv, sizeof(tv));
+  PROF_END(PROF_CRAFT, t_craft);
   //  Calculate Checksum
   // Checksum must be 0 before calculation
+  PROF_START(t_sum);
   icmp->icmp_cksum = 0;
-  icmp->icmp_cksum = checksum(buf, PING_PKT_SIZE);
+  icmp->icmp_cksum = checksum(buf, ping->pkt_size);
+  PROF_END(PROF_CHECKSUM, t_sum);
 }
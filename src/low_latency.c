@@ -0,0 +1,133 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                        ______                                              */
+/*                     .-"      "-.                                           */
+/*                    /            \                                          */
+/*        _          |              |          _                              */
+/*       ( \         |,  .-.  .-.  ,|         / )                             */
+/*        > "=._     | )(__/  \__)( |     _.=" <                              */
+/*       (_/"=._"=._ |/     /\     \| _.="_.="\_)                             */
+/*              "=._ (_     ^^     _)"_.="                                    */
+/*                  "=\__|IIIIII|__/="                                        */
+/*                 _.="| \IIIIII/ |"=._                                       */
+/*       _     _.="_.="\          /"=._"=._     _                             */
+/*      ( \_.="_.="     `--------`     "=._"=._/ )                            */
+/*       > _.="                            "=._ <                             */
+/*      (_/                                    \_)                            */
+/*                                                                            */
+/*      Filename: low_latency.c                                               */
+/*      By: espadara <espadara@pirate.capn.gg>                                */
+/*      Created: 2025/12/06 10:12:40 by espadara                              */
+/*      Updated: 2025/12/06 10:12:40 by espadara                              */
+/*                                                                            */
+/* ************************************************************************** */
+
+#define _GNU_SOURCE
+#include "ft_ping.h"
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+/**
+ * prefault_stack - Touches the stack pages the loop will use.
+ *
+ * mlockall(MCL_FUTURE) only pins pages once they exist, so we walk
+ * a chunk of stack now to take the page faults before the first ping.
+ */
+static void prefault_stack(void)
+{
+  volatile char dummy[LL_PREFAULT_STACK];
+  size_t        i;
+
+  for (i = 0; i < sizeof(dummy); i += 4096)
+    dummy[i] = 0;
+}
+
+static void pin_cpu(int cpu)
+{
+  cpu_set_t set;
+
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (sched_setaffinity(0, sizeof(set), &set) < 0)
+    sea_printf("ft_ping: warning: cannot pin to CPU %d: %s\n", cpu, strerror(errno));
+}
+
+/**
+ * set_realtime - Moves the process to SCHED_FIFO.
+ *
+ * Not fatal: without CAP_SYS_NICE we keep spinning at normal priority.
+ * Only called with an explicit --cpu: a FIFO task spinning on the CPU
+ * that takes the NIC's interrupts starves ksoftirqd, i.e. the very work
+ * that delivers our reply, and RT throttling only lets it run for 50 ms
+ * per second.
+ */
+static void set_realtime(void)
+{
+  struct sched_param param;
+
+  sea_memset(&param, 0, sizeof(param));
+  param.sched_priority = LL_FIFO_PRIORITY;
+  if (sched_setscheduler(0, SCHED_FIFO, &param) < 0)
+    sea_printf("ft_ping: warning: SCHED_FIFO unavailable: %s\n", strerror(errno));
+}
+
+/**
+ * setup_low_latency - Prepares the ship for microsecond measurements.
+ * @ping: The global ping structure (socket must already be open).
+ *
+ * 1. Pins the process to ping->cpu and requests SCHED_FIFO (if --cpu).
+ * 2. Locks all memory and prefaults the stack.
+ * 3. Switches the socket to non-blocking (+ SO_BUSY_POLL if requested).
+ */
+void setup_low_latency(t_ping *ping)
+{
+  int flags;
+
+  if (ping->cpu >= 0)
+    {
+      pin_cpu(ping->cpu);
+      set_realtime();
+    }
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+    sea_printf("ft_ping: warning: mlockall failed: %s\n", strerror(errno));
+  prefault_stack();
+
+  flags = fcntl(ping->sockfd, F_GETFL, 0);
+  if (flags < 0 || fcntl(ping->sockfd, F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+      sea_printf("ft_ping: Failed to set non-blocking socket: %s\n", strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+  if (ping->busy_poll > 0
+      && setsockopt(ping->sockfd, SOL_SOCKET, SO_BUSY_POLL,
+                    &ping->busy_poll, sizeof(ping->busy_poll)) < 0)
+    sea_printf("ft_ping: warning: SO_BUSY_POLL failed: %s\n", strerror(errno));
+}
+
+/**
+ * spin_recv - Busy-waits on the non-blocking socket.
+ *
+ * Same contract as the blocking receive with SO_RCVTIMEO: returns
+ * the packet size, or -1 once LL_RECV_TIMEOUT_US has elapsed.
+ */
+ssize_t spin_recv(t_ping *ping, char *buf, size_t len)
+{
+  struct timespec start;
+  struct timespec now;
+  ssize_t         ret;
+  long            waited;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while (1)
+    {
+      ret = recv_packet(ping->sockfd, buf, len, 0, &ping->stats.rx_dropped);
+      if (ret >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        return (ret);
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      waited = (now.tv_sec - start.tv_sec) * 1000000L
+        + (now.tv_nsec - start.tv_nsec) / 1000L;
+      if (waited >= LL_RECV_TIMEOUT_US)
+        return (-1);
+    }
+}
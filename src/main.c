@@ -36,6 +36,16 @@ void print_usage(void)
     sea_printf("  -f, --flood        flood ping\n");
     sea_printf("      --ttl=N        specify N as time-to-live\n");
     sea_printf("  -w <deadline>      timeout before ping exits (in seconds)\n");
+    sea_printf("      --low-latency  busy-poll the socket, lock memory\n");
+    sea_printf("      --cpu=N        pin to CPU N and request SCHED_FIFO (with --low-latency);\n");
+    sea_printf("                     never the CPU that handles the NIC's IRQs, or the\n");
+    sea_printf("                     spin starves the softirq that delivers the replies\n");
+    sea_printf("      --busy-poll=N  set SO_BUSY_POLL to N usec (with --low-latency)\n");
+    sea_printf("      --rcvbuf=N     set socket receive buffer to N bytes\n");
+    sea_printf("      --sndbuf=N     set socket send buffer to N bytes\n");
+    sea_printf("      --profile      print a per-stage timing breakdown at exit\n");
+    sea_printf("                     (needs a build with make PROFILE=1)\n");
+    sea_printf("      --daemon=PATH  keep probing, take commands on the Unix socket PATH\n");
     sea_printf("  -?, --help         give this help list\n");
     sea_printf("\n");
     sea_printf("Mandatory or optional arguments to long options are also mandatory for any corresponding short options.\n");
@@ -75,6 +85,57 @@ static void parse_args(t_ping *ping, int argc, char **argv)
               }
               ping->deadline = sea_atoi(argv[++i]);
             }
+          else if (sea_strcmp(argv[i], "--low-latency") == 0)
+            ping->low_latency = 1;
+          else if (sea_strcmp(argv[i], "--cpu") == 0)
+            {
+              if (i + 1 >= argc) {
+                sea_printf("ft_ping: option '--cpu' requires an argument\n");
+                exit(EXIT_FAILURE);
+              }
+              ping->cpu = sea_atoi(argv[++i]);
+            }
+          else if (sea_strcmp(argv[i], "--busy-poll") == 0)
+            {
+              if (i + 1 >= argc) {
+                sea_printf("ft_ping: option '--busy-poll' requires an argument\n");
+                exit(EXIT_FAILURE);
+              }
+              ping->busy_poll = sea_atoi(argv[++i]);
+            }
+          else if (sea_strcmp(argv[i], "--rcvbuf") == 0)
+            {
+              if (i + 1 >= argc) {
+                sea_printf("ft_ping: option '--rcvbuf' requires an argument\n");
+                exit(EXIT_FAILURE);
+              }
+              ping->rcvbuf = sea_atoi(argv[++i]);
+            }
+          else if (sea_strcmp(argv[i], "--sndbuf") == 0)
+            {
+              if (i + 1 >= argc) {
+                sea_printf("ft_ping: option '--sndbuf' requires an argument\n");
+                exit(EXIT_FAILURE);
+              }
+              ping->sndbuf = sea_atoi(argv[++i]);
+            }
+          else if (sea_strcmp(argv[i], "--profile") == 0)
+            {
+#ifdef FT_PING_PROFILE
+              g_profile = 1;
+#else
+              sea_printf("ft_ping: built without profiling, rebuild with 'make re PROFILE=1'\n");
+              exit(EXIT_FAILURE);
+#endif
+            }
+          else if (sea_strcmp(argv[i], "--daemon") == 0)
+            {
+              if (i + 1 >= argc) {
+                sea_printf("ft_ping: option '--daemon' requires an argument\n");
+                exit(EXIT_FAILURE);
+              }
+              ping->ctl_path = argv[++i];
+            }
             else
             {
                 sea_printf("ft_ping: invalid option -- '%s'\n", argv[i] + 1);
@@ -92,7 +153,17 @@ static void parse_args(t_ping *ping, int argc, char **argv)
           ping->hostname = argv[i];
         }
     }
-  if (ping->hostname == NULL)
+  if (!ping->low_latency && (ping->cpu >= 0 || ping->busy_poll > 0))
+    {
+      sea_printf("ft_ping: usage error: --cpu and --busy-poll require --low-latency\n");
+      exit(EXIT_FAILURE);
+    }
+  if (ping->ctl_path != NULL && (ping->flood || ping->low_latency || PROF_ENABLED))
+    {
+      sea_printf("ft_ping: usage error: --daemon cannot be combined with --flood, --low-latency or --profile\n");
+      exit(EXIT_FAILURE);
+    }
+  if (ping->hostname == NULL && ping->ctl_path == NULL)
     {
       sea_printf("ft_ping: usage error: Destination address required\n");
       exit(EXIT_FAILURE);
@@ -111,6 +182,13 @@ static void init_struct(t_ping *ping)
   ping->flood = 0;
   ping->ttl = TTL_DEFAULT;
   ping->deadline = 0;
+  ping->low_latency = 0;
+  ping->cpu = -1;
+  ping->busy_poll = 0;
+  ping->pkt_size = PING_PKT_SIZE;
+  ping->rcvbuf = 0;
+  ping->sndbuf = 0;
+  ping->ctl_path = NULL;
   g_ping = ping;
 }
 
@@ -127,10 +205,17 @@ int main(int argc, char **argv)
   init_struct(&ping);
   // Parse
   parse_args(&ping, argc, argv);
+  if (ping.ctl_path != NULL)
+    {
+      run_daemon(&ping);
+      return (EXIT_SUCCESS);
+    }
   // Setup signals
   signal(SIGINT, handle_signal);
   // Launch
   init_socket(&ping);
+  if (ping.low_latency)
+    setup_low_latency(&ping);
   loop_ping(&ping);
 
   return (EXIT_SUCCESS);
@@ -25,7 +25,7 @@
 #include "ft_ping.h"
 
 /* Helper: Calculate time difference in milliseconds */
-static double get_time_diff(struct timeval *start, struct timeval *end)
+double get_time_diff(struct timeval *start, struct timeval *end)
 {
   double s;
   double e;
@@ -51,7 +51,7 @@ static int check_deadline(t_ping *ping)
   return (0);
 }
 
-static void update_stats(t_ping *ping, double rtt)
+void update_stats(t_ping *ping, double rtt)
 {
   ping->stats.rx_packets++;
   ping->stats.t_sum += rtt;
@@ -90,43 +90,61 @@ static void print_reply(t_ping *ping, char *buf, ssize_t ret, double rtt)
 
 void loop_ping(t_ping *ping)
 {
-  char            send_buf[PING_PKT_SIZE];
+  char            send_buf[PING_PKT_MAX];
   char            recv_buf[RECV_BUFFER_SIZE];
   char            src_ip[INET_ADDRSTRLEN];
-  struct sockaddr_in from_addr;
-  socklen_t       addr_len;
   int             seq;
   ssize_t         ret;
   struct ip       *ip_header;
   struct icmp     *icmp_header;
+  int             mine;
+  double          rtt;
 
   seq = 0;
+  rtt = 0.0;
+  // Touch the buffers now so no page fault lands inside a measured RTT
+  sea_bzero(recv_buf, RECV_BUFFER_SIZE);
   while (1)
     {
 
       // Check deadline
       if (check_deadline(ping))
         handle_signal(SIGINT);
+      PROF_START(t_loop);
       // --- SEND ---
-      sea_bzero(send_buf, PING_PKT_SIZE);
       craft_packet(ping, send_buf, ++seq);
-      if (sendto(ping->sockfd, send_buf, PING_PKT_SIZE, 0,
-                 (struct sockaddr *)&ping->dest_addr, sizeof(ping->dest_addr)) < 0)
+      PROF_START(t_send);
+      ret = sendto(ping->sockfd, send_buf, ping->pkt_size, 0,
+                   (struct sockaddr *)&ping->dest_addr, sizeof(ping->dest_addr));
+      PROF_END(PROF_SEND, t_send);
+      if (ret < 0)
         {
-          if (ping->verbose) sea_printf("ft_ping: sendto error\n");
-          if (ping->flood) write(1, "E", 1);
+          // Our own queue is full: a host-local drop, not a send failure
+          if (errno == ENOBUFS || errno == EAGAIN)
+            ping->stats.tx_nobufs++;
+          else if (ping->verbose)
+            sea_printf("ft_ping: sendto error\n");
+        }
+      else
+        ping->stats.tx_packets++;
+      if (ping->flood)
+        {
+          PROF_START(t_mark);
+          write(1, ret < 0 ? "E" : ".", 1);
+          PROF_END(PROF_OUTPUT, t_mark);
         }
-      else{
-          ping->stats.tx_packets++;
-          if (ping->flood) write (1, ".", 1);
-          }
 
       // --- Recieve ---
-        addr_len = sizeof(from_addr);
-        ret = recvfrom(ping->sockfd, recv_buf, RECV_BUFFER_SIZE, 0,
-                       (struct sockaddr *)&from_addr, &addr_len);
+        PROF_START(t_recv);
+        if (ping->low_latency)
+          ret = spin_recv(ping, recv_buf, RECV_BUFFER_SIZE);
+        else
+          ret = recv_packet(ping->sockfd, recv_buf, RECV_BUFFER_SIZE, 0,
+                            &ping->stats.rx_dropped);
+        PROF_END(PROF_RECV, t_recv);
         if (ret > 0)
           {
+            PROF_START(t_parse);
             // Unpack IP Header to find ICMP
             ip_header = (struct ip *)recv_buf;
             icmp_header = (struct icmp *)(recv_buf + (ip_header->ip_hl << 2));
@@ -135,8 +153,9 @@ void loop_ping(t_ping *ping)
             inet_ntop(AF_INET, &ip_header->ip_src, src_ip, INET_ADDRSTRLEN);
 
             // Check: Is it an Echo Reply (Type 0) and is it OURS (ID match)?
-            if (icmp_header->icmp_type == ICMP_ECHOREPLY &&
-                icmp_header->icmp_id == htons(ping->pid))
+            mine = (icmp_header->icmp_type == ICMP_ECHOREPLY &&
+                    icmp_header->icmp_id == htons(ping->pid));
+            if (mine)
               {
                 // Retrieve the timestamp we hid in the payload
                 struct timeval sent_time;
@@ -145,22 +164,27 @@ void loop_ping(t_ping *ping)
                 char *payload = recv_buf + (ip_header->ip_hl << 2) + 8;
                 sea_memcpy_fast(&sent_time, payload, sizeof(sent_time));
                 gettimeofday(&curr_time, NULL);
-
-                double rtt = get_time_diff(&sent_time, &curr_time);
-                update_stats(ping, rtt);
-
-                if (ping->flood)
-                  write(1, "\b \b", 3);
-                else
-                  print_reply(ping, recv_buf, ret, rtt);
+                rtt = get_time_diff(&sent_time, &curr_time);
               }
-            else if (ping->verbose)
+            PROF_END(PROF_PARSE, t_parse);
+
+            if (mine)
               {
-                if (!ping->flood)
-                  sea_printf("%d bytes from %s: type=%d code=%d\n",
-                             ret, src_ip, icmp_header->icmp_type, icmp_header->icmp_code);
+                PROF_START(t_stats);
+                update_stats(ping, rtt);
+                PROF_END(PROF_STATS, t_stats);
               }
+            PROF_START(t_output);
+            if (mine && ping->flood)
+              write(1, "\b \b", 3);
+            else if (mine)
+              print_reply(ping, recv_buf, ret, rtt);
+            else if (ping->verbose && !ping->flood)
+              sea_printf("%d bytes from %s: type=%d code=%d\n",
+                         ret, src_ip, icmp_header->icmp_type, icmp_header->icmp_code);
+            PROF_END(PROF_OUTPUT, t_output);
           }
+        PROF_END(PROF_LOOP, t_loop);
         if (!ping->flood)
           sleep(ping->interval);
     }
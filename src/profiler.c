@@ -0,0 +1,128 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                        ______                                              */
+/*                     .-"      "-.                                           */
+/*                    /            \                                          */
+/*        _          |              |          _                              */
+/*       ( \         |,  .-.  .-.  ,|         / )                             */
+/*        > "=._     | )(__/  \__)( |     _.=" <                              */
+/*       (_/"=._"=._ |/     /\     \| _.="_.="\_)                             */
+/*              "=._ (_     ^^     _)"_.="                                    */
+/*                  "=\__|IIIIII|__/="                                        */
+/*                 _.="| \IIIIII/ |"=._                                       */
+/*       _     _.="_.="\          /"=._"=._     _                             */
+/*      ( \_.="_.="     `--------`     "=._"=._/ )                            */
+/*       > _.="                            "=._ <                             */
+/*      (_/                                    \_)                            */
+/*                                                                            */
+/*      Filename: profiler.c                                                  */
+/*      By: espadara <espadara@pirate.capn.gg>                                */
+/*      Created: 2025/12/08 18:45:03 by espadara                              */
+/*      Updated: 2025/12/08 18:45:03 by espadara                              */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "ft_ping.h"
+
+/* Only built with `make PROFILE=1`; see the PROF_* macros in ft_ping.h */
+
+int g_profile = 0;
+
+static t_prof_stage g_stages[PROF_COUNT];
+
+static const char *g_stage_names[PROF_COUNT] = {
+  "craft", "checksum", "sendto", "recv wait", "parse",
+  "update_stats", "output", "loop"
+};
+
+/**
+ * prof_record - Adds one sample to a stage.
+ * @stage: Which stage just finished.
+ * @start: prof_now() taken when it began.
+ *
+ * The histogram is log2(ns): bucket b holds [2^(b-1), 2^b) ns.
+ * Fixed size, no malloc, O(1) per sample.
+ */
+void prof_record(t_prof_id stage, uint64_t start)
+{
+  uint64_t     ns;
+  int          b;
+
+  ns = prof_now() - start;
+  b = 0;
+  if (ns > 0)
+    b = 64 - __builtin_clzll(ns);
+  if (b >= PROF_BUCKETS)
+    b = PROF_BUCKETS - 1;
+  g_stages[stage].count++;
+  g_stages[stage].sum_ns += ns;
+  g_stages[stage].hist[b]++;
+}
+
+/**
+ * percentile_ns - Reads a percentile back out of the log2 histogram.
+ *
+ * Interpolates linearly inside the bucket, so it is exact to within
+ * one power of two: plenty to rank stages against each other.
+ */
+static double percentile_ns(t_prof_stage *st, double pct)
+{
+  uint64_t rank;
+  uint64_t seen;
+  double   lo;
+  double   hi;
+  int      b;
+
+  rank = (uint64_t)(st->count * pct);
+  if (rank >= st->count)
+    rank = st->count - 1;
+  seen = 0;
+  for (b = 0; b < PROF_BUCKETS; b++)
+    {
+      if (seen + st->hist[b] > rank)
+        break;
+      seen += st->hist[b];
+    }
+  if (b == 0)
+    return (0.0);
+  lo = (double)(1ULL << (b - 1));
+  hi = lo * 2.0;
+  return (lo + (hi - lo) * (double)(rank - seen + 1) / (double)st->hist[b]);
+}
+
+/**
+ * prof_report - Prints the per-stage breakdown at exit.
+ *
+ * share is the stage's total time over the loop's (send to output,
+ * without the sleep between pings). recv wait includes the network RTT.
+ * Whatever no stage claims is printed as unattributed.
+ */
+void prof_report(void)
+{
+  t_prof_stage *st;
+  double       loop_ns;
+  double       staged_ns;
+  int          i;
+
+  loop_ns = (double)g_stages[PROF_LOOP].sum_ns;
+  sea_printf("--- profile (CLOCK_MONOTONIC_RAW, %ld loops) ---\n",
+             (long)g_stages[PROF_LOOP].count);
+  staged_ns = 0.0;
+  for (i = 0; i < PROF_COUNT; i++)
+    {
+      st = &g_stages[i];
+      if (i != PROF_LOOP)
+        staged_ns += (double)st->sum_ns;
+      if (st->count == 0)
+        continue;
+      sea_printf("%s: mean=%.3f us p99=%.3f us share=%.1f%%\n",
+                 g_stage_names[i],
+                 (double)st->sum_ns / st->count / 1000.0,
+                 percentile_ns(st, 0.99) / 1000.0,
+                 loop_ns > 0.0 ? st->sum_ns * 100.0 / loop_ns : 0.0);
+    }
+  // Counters, branches and the clock reads themselves
+  if (loop_ns > 0.0)
+    sea_printf("unattributed: share=%.1f%%\n",
+               (loop_ns - staged_ns) * 100.0 / loop_ns);
+}
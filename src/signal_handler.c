@@ -25,13 +25,14 @@
 #include "ft_ping.h"
 
 /**
+ * calculate_stats - Derives average and deviation from the running sums.
  * @ping: The struct containing sums and counts.
  * @avg: Pointer to store the average.
  * @stddev: Pointer to store the standard deviation.
  *
  * Uses the variance formula: Var = E[X^2] - (E[X])^2
  */
-static void calculate_stats(t_ping *ping, double *avg, double *stddev)
+void calculate_stats(t_ping *ping, double *avg, double *stddev)
 {
   double variance;
 
@@ -50,6 +51,36 @@ static void calculate_stats(t_ping *ping, double *avg, double *stddev)
     }
 }
 
+/**
+ * print_drops - Splits the loss into our own drops and the network's.
+ *
+ * Only printed when the host dropped something, so the normal summary
+ * stays identical to ping(8). The socket filter only queues our replies,
+ * but with -v it also queues ICMP errors and a duplicate reply counts
+ * too: those are capped so the two parts still add up to the loss.
+ */
+static void print_drops(t_ping *ping)
+{
+  long missing;
+  long rxq;
+  long net_pct;
+
+  if (ping->stats.rx_dropped == 0 && ping->stats.tx_nobufs == 0)
+    return;
+  missing = ping->stats.tx_packets - ping->stats.rx_packets;
+  if (missing < 0)
+    missing = 0;
+  rxq = ping->stats.rx_dropped;
+  if (rxq > missing)
+    rxq = missing;
+  net_pct = 0;
+  if (ping->stats.tx_packets > 0)
+    net_pct = ((missing - rxq) * 100) / ping->stats.tx_packets;
+  sea_printf("host-local drops: %ld in receive queue, %ld send buffer full; "
+             "network loss: %ld (%ld%%)\n",
+             rxq, ping->stats.tx_nobufs, missing - rxq, net_pct);
+}
+
 /**
  * Example:
  * --- google.com ping statistics ---
@@ -75,6 +106,7 @@ void print_stats(t_ping *ping)
              ping->stats.tx_packets,
              ping->stats.rx_packets,
              loss_pct);
+  print_drops(ping);
 
   if (ping->stats.rx_packets > 0)
     {
@@ -103,6 +135,10 @@ void handle_signal(int sig)
   if (g_ping)
     {
       print_stats(g_ping);
+#ifdef FT_PING_PROFILE
+      if (g_profile)
+        prof_report();
+#endif
       if (g_ping->sockfd > 0)
         close(g_ping->sockfd);
     }
@@ -46,11 +46,13 @@ static void setup_timeout(int sock)
 
 /**
  * resolve_hostname - Converts FQDN to IP address.
- * @ping: The global ping structure.
+ * @ping: The ping structure to fill (dest_addr + ip_str).
  *
  * Uses getaddrinfo to resolve. We only take the first valid IPv4 address.
+ * Returns 0 or the getaddrinfo error code, so the daemon can report it
+ * to its client instead of sinking the whole ship.
  */
-static void resolve_hostname(t_ping *ping)
+int resolve_hostname(t_ping *ping)
 {
   struct addrinfo hints;
   struct addrinfo *res;
@@ -62,28 +64,77 @@ static void resolve_hostname(t_ping *ping)
 
     status = getaddrinfo(ping->hostname, NULL, &hints, &res);
     if (status != 0)
-      {
-        sea_printf("ft_ping: %s: %s\n", ping->hostname, gai_strerror(status));
-        exit(EXIT_FAILURE);
-      }
+      return (status);
     sea_memcpy_fast(&ping->dest_addr, res->ai_addr, sizeof(struct sockaddr_in));
     inet_ntop(AF_INET, &(ping->dest_addr.sin_addr), ping->ip_str, INET_ADDRSTRLEN);
     freeaddrinfo(res);
+    return (0);
 }
 
 /**
- * init_socket - The main setup routine.
- * @ping: The global ping structure.
+ * set_buffer - Sizes a socket buffer (SO_RCVBUF / SO_SNDBUF).
  *
- * 1. Resolves hostname.
- * 2. Opens the RAW socket (requires root).
- * 3. Sets TTL and Timeout options.
+ * Tries the *FORCE variant first: as root it may go past
+ * net.core.rmem_max/wmem_max, which is the whole point for floods.
  */
-void init_socket(t_ping *ping)
+static void set_buffer(int sock, int force_opt, int opt, int size, char *name)
 {
-  int ttl_val;
+  if (size <= 0)
+    return;
+  if (setsockopt(sock, SOL_SOCKET, force_opt, &size, sizeof(size)) == 0)
+    return;
+  if (setsockopt(sock, SOL_SOCKET, opt, &size, sizeof(size)) < 0)
+    sea_printf("ft_ping: warning: %s failed: %s\n", name, strerror(errno));
+}
 
-  resolve_hostname(ping);
+/**
+ * recv_packet - recvmsg() wrapper that also reads the kernel drop counter.
+ * @sockfd: The socket.
+ * @buf: Where the packet goes.
+ * @len: Size of @buf.
+ * @flags: recvmsg flags (e.g. MSG_DONTWAIT).
+ * @drops: Updated with the SO_RXQ_OVFL counter when the kernel sends one.
+ *
+ * The counter is cumulative and only attached once it is non-zero.
+ */
+ssize_t recv_packet(int sockfd, char *buf, size_t len, int flags, long *drops)
+{
+  struct msghdr   msg;
+  struct iovec    iov;
+  struct cmsghdr  *cmsg;
+  char            control[CMSG_SPACE(sizeof(uint32_t))];
+  uint32_t        count;
+  ssize_t         ret;
+
+  sea_memset(&msg, 0, sizeof(msg));
+  iov.iov_base = buf;
+  iov.iov_len = len;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  ret = recvmsg(sockfd, &msg, flags);
+  if (ret < 0)
+    return (ret);
+  for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+        {
+          sea_memcpy_fast(&count, CMSG_DATA(cmsg), sizeof(count));
+          *drops = count;
+        }
+    }
+  return (ret);
+}
+
+/**
+ * open_socket - Opens the RAW ICMP socket and sets its options.
+ * @ping: The ping structure (sockfd is filled, ttl/rcvbuf/sndbuf are read).
+ */
+void open_socket(t_ping *ping)
+{
+  int ttl_val;
+  int on;
 
   ping->sockfd = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
   if (ping->sockfd < 0)
@@ -104,8 +155,84 @@ void init_socket(t_ping *ping)
         sea_printf("ft_ping: Failed to set TTL\n");
         exit(EXIT_FAILURE);
       }
-    setup_timeout(ping->sockfd);
-    gettimeofday(&ping->start_time, NULL);
-    sea_printf("PING %s (%s): %d data bytes\n",
-        ping->hostname, ping->ip_str, PING_PKT_SIZE - 8);
+    // Ask the kernel to tell us how many replies it threw away
+    on = 1;
+    if (setsockopt(ping->sockfd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) != 0)
+      sea_printf("ft_ping: warning: SO_RXQ_OVFL failed: %s\n", strerror(errno));
+    set_buffer(ping->sockfd, SO_RCVBUFFORCE, SO_RCVBUF, ping->rcvbuf, "SO_RCVBUF");
+    set_buffer(ping->sockfd, SO_SNDBUFFORCE, SO_SNDBUF, ping->sndbuf, "SO_SNDBUF");
+}
+
+/**
+ * set_icmp_filter - Keeps everything but our own replies out of the queue.
+ * @sockfd: The raw ICMP socket.
+ * @id: First ICMP id that is ours.
+ * @count: How many ids are ours (1, or one per daemon target).
+ * @errors: Also let Unreachable / Time Exceeded / Parameter Problem in.
+ *
+ * A raw ICMP socket gets a copy of every ICMP packet on the host: our own
+ * Echo Requests looped back, other pings' replies... They would fill the
+ * queue and show up in SO_RXQ_OVFL as our drops. The classic BPF program
+ * runs before the packet is queued, so the drop counter only sees what
+ * passes it. The id test wraps like handle_reply's: (id - first) & 0xffff.
+ */
+void set_icmp_filter(int sockfd, int id, int count, int errors)
+{
+  struct sock_filter  code[] = {
+    BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0),                 // X = IP hlen
+    BPF_STMT(BPF_LD | BPF_B | BPF_IND, 0),                  // A = type
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_ECHOREPLY, 0, 4),
+    BPF_STMT(BPF_LD | BPF_H | BPF_IND, 4),                  // A = id
+    BPF_STMT(BPF_ALU | BPF_SUB | BPF_K, (uint32_t)id),
+    BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xFFFF),
+    BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, (uint32_t)count, 5, 4),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_DEST_UNREACH, 2, 0),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_TIME_EXCEEDED, 1, 0),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_PARAMETERPROB, 0, 2),
+    BPF_STMT(BPF_RET | BPF_K, errors ? 0xFFFF : 0),
+    BPF_STMT(BPF_RET | BPF_K, 0xFFFF),                      // accept
+    BPF_STMT(BPF_RET | BPF_K, 0),                           // drop
+  };
+  struct sock_fprog   prog;
+  char                buf[RECV_BUFFER_SIZE];
+  long                drops;
+
+  prog.len = sizeof(code) / sizeof(code[0]);
+  prog.filter = code;
+  if (setsockopt(sockfd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0)
+    {
+      sea_printf("ft_ping: warning: SO_ATTACH_FILTER failed: %s\n", strerror(errno));
+      return;
+    }
+  // Whatever slipped in between socket() and here was not filtered
+  while (recv_packet(sockfd, buf, sizeof(buf), MSG_DONTWAIT, &drops) >= 0)
+    ;
+}
+
+/**
+ * init_socket - The main setup routine.
+ * @ping: The global ping structure.
+ *
+ * 1. Resolves hostname.
+ * 2. Opens the RAW socket (requires root) and sets TTL.
+ * 3. Filters it down to our replies (and errors, if they get printed).
+ * 4. Sets the receive Timeout.
+ */
+void init_socket(t_ping *ping)
+{
+  int status;
+
+  status = resolve_hostname(ping);
+  if (status != 0)
+    {
+      sea_printf("ft_ping: %s: %s\n", ping->hostname, gai_strerror(status));
+      exit(EXIT_FAILURE);
+    }
+  open_socket(ping);
+  set_icmp_filter(ping->sockfd, ping->pid & 0xFFFF, 1,
+                  ping->verbose && !ping->flood);
+  setup_timeout(ping->sockfd);
+  gettimeofday(&ping->start_time, NULL);
+  sea_printf("PING %s (%s): %d data bytes\n",
+      ping->hostname, ping->ip_str, ping->pkt_size - 8);
 }
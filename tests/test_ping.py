@@ -33,6 +33,7 @@ import os
 # Colors for output
 GREEN = '\033[92m'
 RED = '\033[91m'
+YELLOW = '\033[93m'
 RESET = '\033[0m'
 BOLD = '\033[1m'
 
@@ -45,6 +46,9 @@ def print_status(test_name, passed, message=""):
     else:
         print(f"{RED}[FAIL] {test_name}{RESET} {message}")
 
+def print_skip(test_name, message=""):
+    print(f"{YELLOW}[SKIP] {test_name}{RESET} {message}")
+
 def run_ping(args, duration=2, expect_fail=False):
     """
     Runs ft_ping, waits 'duration' seconds, sends SIGINT, and captures output.
@@ -128,6 +132,166 @@ def test_deadline_flag():
     else:
         print_status("Deadline Timing", False, f"(Expected ~3s, took {elapsed:.2f}s)")
 
+def test_low_latency():
+    print(f"\n{BOLD}--- Test: Low-Latency Mode ---{RESET}")
+    passed, msg, out, err = run_ping(["--low-latency", "--cpu", "0", "--busy-poll", "50", "127.0.0.1"], duration=2)
+
+    # Spinning must still deliver replies and a clean summary on SIGINT
+    if passed and "bytes from 127.0.0.1" in out and "ping statistics" in out:
+        print_status("Low-Latency Loopback", True)
+    else:
+        print_status("Low-Latency Loopback", False, f"{msg}\nOutput:\n{out}")
+
+    # Tuning knobs without the mode itself must be refused, not ignored
+    passed, msg, out, err = run_ping(["--cpu", "0", "127.0.0.1"], duration=0.5, expect_fail=True)
+    if passed and "require --low-latency" in out:
+        print_status("Low-Latency Options Alone", True)
+    else:
+        print_status("Low-Latency Options Alone", False, f"{msg}\nOutput:\n{out}")
+
+def test_flood_buffers():
+    print(f"\n{BOLD}--- Test: Flood with Socket Buffers ---{RESET}")
+    passed, msg, out, err = run_ping(["-f", "-v", "--rcvbuf", "4096", "--sndbuf", "4096", "127.0.0.1"], duration=1)
+
+    # The socket filter keeps our own looped-back requests out of the 4 KiB
+    # queue, so loopback keeps up: nothing may be blamed on the host, and
+    # full send queues are never send errors
+    m = re.search(r"(\d+) packets transmitted, (\d+) packets received", out)
+    if (passed and m and int(m.group(1)) > 1000 and int(m.group(1)) - int(m.group(2)) <= 1
+            and "host-local drops" not in out and "sendto error" not in out):
+        print_status("Flood Buffers", True, f"({m.group(1)} packets, no spurious drops)")
+    else:
+        print_status("Flood Buffers", False, f"{msg}\nOutput:\n{out[-500:]}")
+
+    # Unfiltered, each recv returned our own request and replies came a
+    # whole interval late (~1000 ms on loopback)
+    passed, msg, out, err = run_ping(["127.0.0.1"], duration=2.5)
+    times = [float(t) for t in re.findall(r"time=([0-9.]+) ms", out)]
+    if passed and times and max(times) < 100.0:
+        print_status("Loopback RTT", True, f"(max {max(times):.3f} ms)")
+    else:
+        print_status("Loopback RTT", False, f"{msg}\nOutput:\n{out}")
+
+def test_profile():
+    print(f"\n{BOLD}--- Test: Profiler (--profile) ---{RESET}")
+    passed, msg, out, err = run_ping(["-f", "--profile", "127.0.0.1"], duration=1)
+
+    if "built without profiling" in out:
+        print_skip("Profile Breakdown", "(rebuild with 'make re PROFILE=1' to run it)")
+        return
+
+    # Every stage must report, each share within the loop, and the stages
+    # plus the unattributed rest must account for the whole loop
+    stages = ["craft", "checksum", "sendto", "recv wait", "parse", "update_stats", "output", "loop"]
+    shares = {}
+    for name in stages:
+        m = re.search(rf"^{name}: mean=[0-9.]+ us p99=[0-9.]+ us share=([0-9.]+)%$", out, re.M)
+        if m:
+            shares[name] = float(m.group(1))
+    rest = re.search(r"^unattributed: share=(-?[0-9.]+)%$", out, re.M)
+
+    missing = [name for name in stages if name not in shares]
+    if missing or not rest:
+        print_status("Profile Breakdown", False, f"Missing stages {missing}.\nOutput:\n{out[-800:]}")
+        return
+    staged = sum(v for k, v in shares.items() if k != "loop")
+    total = staged + float(rest.group(1))
+    if (shares["loop"] == 100.0 and all(0.0 <= v <= 100.0 for v in shares.values())
+            and 0.0 <= float(rest.group(1)) < 50.0 and abs(total - 100.0) < 1.0):
+        print_status("Profile Breakdown", True, f"(stages cover {staged:.1f}% of the loop)")
+    else:
+        print_status("Profile Breakdown", False, f"Shares do not add up.\nOutput:\n{out[-800:]}")
+
+def daemon_send(ctl, line):
+    """
+    Sends one command to the daemon's control socket and returns the reply.
+    """
+    import socket
+    s = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    s.connect(ctl)
+    s.sendall((line + "\n").encode())
+    reply = b""
+    while (not reply.endswith(b"\n")
+           or (line.startswith("stats") and b"end" not in reply
+               and not reply.startswith(b"error"))):
+        chunk = s.recv(4096)
+        if not chunk:
+            break
+        reply += chunk
+    s.close()
+    return reply.decode()
+
+def test_daemon():
+    print(f"\n{BOLD}--- Test: Daemon Mode ---{RESET}")
+    ctl = "/tmp/ft_ping_test.sock"
+    cmd = [FT_PING, "--daemon", ctl, "127.0.0.1"]
+    if NEEDS_SUDO: cmd = ["sudo"] + cmd
+    proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+    time.sleep(0.5)
+
+    def send(line):
+        return daemon_send(ctl, line)
+
+    try:
+        added = send("add 127.0.0.1 ttl=32 size=100")
+        changed = send("set 0 interval=2")
+        named = send("add localhost")
+        # IDs past INT_MAX used to wrap to a negative slot
+        huge = [send("stats 4294967295"), send("set 4294967295 ttl=9"),
+                send("del 4294967295"), send("stats 0x1")]
+        junk = [send("set 0 ttl=5x"), send("set 0 interval=-1"),
+                send("add 127.0.0.1 size=99999999999")]
+        time.sleep(1.5)
+        stats = send("stats")
+        send("shutdown")
+        out, err = proc.communicate(timeout=2)
+    except Exception as e:
+        proc.kill()
+        print_status("Daemon Control", False, str(e))
+        return
+
+    # Both targets must have been probed, target 1 with its own settings
+    # Names are refused: resolving them would stall the probe loop
+    if (added == "ok 1\n" and changed == "ok\n" and named.startswith("error")
+            and all(r == "error no such target\n" for r in huge)
+            and all(r == "error bad option or value\n" for r in junk)
+            and "1 127.0.0.1 127.0.0.1 interval=1 ttl=32 size=100" in stats
+            and re.search(r"^0 .* rx=[1-9]", stats, re.M)
+            and "ping statistics" in out):
+        print_status("Daemon Control", True)
+    else:
+        print_status("Daemon Control", False, f"Replies:\n{added}{changed}{named}{''.join(huge + junk)}{stats}Output:\n{out}")
+
+def test_daemon_interval():
+    print(f"\n{BOLD}--- Test: Daemon Interval Change ---{RESET}")
+    ctl = "/tmp/ft_ping_test.sock"
+    cmd = [FT_PING, "--daemon", ctl]
+    if NEEDS_SUDO: cmd = ["sudo"] + cmd
+    proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+    time.sleep(0.5)
+
+    try:
+        daemon_send(ctl, "add 127.0.0.1 interval=3600")
+        time.sleep(0.5)
+        before = daemon_send(ctl, "stats 0")
+        daemon_send(ctl, "set 0 interval=1")
+        time.sleep(2.5)
+        after = daemon_send(ctl, "stats 0")
+        daemon_send(ctl, "shutdown")
+        proc.communicate(timeout=2)
+    except Exception as e:
+        proc.kill()
+        print_status("Interval Lowered", False, str(e))
+        return
+
+    # The hour-long wait must be cut short by the new 1s interval
+    tx_before = re.search(r"tx=(\d+)", before)
+    tx_after = re.search(r"tx=(\d+)", after)
+    if tx_before and tx_after and int(tx_after.group(1)) >= int(tx_before.group(1)) + 2:
+        print_status("Interval Lowered", True)
+    else:
+        print_status("Interval Lowered", False, f"Before:\n{before}After:\n{after}")
+
 def test_errors():
     print(f"\n{BOLD}--- Test: Error Handling ---{RESET}")
 
@@ -167,6 +331,11 @@ def main():
     test_basic_localhost()
     test_ttl_flag()
     test_deadline_flag()
+    test_low_latency()
+    test_flood_buffers()
+    test_profile()
+    test_daemon()
+    test_daemon_interval()
     test_errors()
     test_help()
 